@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    Single channel biquad used by both filter paths of the processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/**
+    Runs a second order juce::dsp::IIR::Coefficients set the same way
+    juce::dsp::IIR::Filter does (transposed direct form II), but keeps its two
+    state values reachable so one channel can take over another channel's
+    history. That is what lets the processor filter mono content once and
+    still hand over cleanly when the input turns stereo again.
+*/
+class CombBiquad
+{
+public:
+    using CoefficientsPtr = juce::dsp::IIR::Coefficients<float>::Ptr;
+
+    CombBiquad() : coefficients(new juce::dsp::IIR::Coefficients<float>(1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f)) {}
+    explicit CombBiquad(CoefficientsPtr coefficientsToUse) : coefficients(std::move(coefficientsToUse)) {}
+
+    void prepare(const juce::dsp::ProcessSpec&) noexcept { reset(); }
+    void reset() noexcept { state1 = state2 = 0.0f; }
+
+    void copyStateFrom(const CombBiquad& other) noexcept
+    {
+        state1 = other.state1;
+        state2 = other.state2;
+    }
+
+    bool hasSameStateAs(const CombBiquad& other) const noexcept
+    {
+        return state1 == other.state1 && state2 == other.state2;
+    }
+
+    template <typename ProcessContext>
+    void process(const ProcessContext& context) noexcept
+    {
+        auto&& inputBlock = context.getInputBlock();
+        auto&& outputBlock = context.getOutputBlock();
+
+        jassert(inputBlock.getNumChannels() == 1 && outputBlock.getNumChannels() == 1);
+        jassert(coefficients->getFilterOrder() == 2);
+
+        const auto numSamples = outputBlock.getNumSamples();
+        auto* input = inputBlock.getChannelPointer(0);
+        auto* output = outputBlock.getChannelPointer(0);
+
+        if (context.isBypassed) {
+            if (input != output)
+                juce::FloatVectorOperations::copy(output, input, (int)numSamples);
+            return;
+        }
+
+        const auto* c = coefficients->getRawCoefficients();
+        const float b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+        float s1 = state1, s2 = state2;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            const float in = input[i];
+            const float out = b0 * in + s1;
+            output[i] = out;
+            s1 = b1 * in - a1 * out + s2;
+            s2 = b2 * in - a2 * out;
+        }
+
+        juce::dsp::util::snapToZero(s1);
+        juce::dsp::util::snapToZero(s2);
+        state1 = s1;
+        state2 = s2;
+    }
+
+    CoefficientsPtr coefficients;
+
+private:
+    float state1 = 0.0f, state2 = 0.0f;
+
+    JUCE_LEAK_DETECTOR(CombBiquad)
+};
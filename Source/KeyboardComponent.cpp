@@ -0,0 +1,157 @@
+/*
+  ==============================================================================
+
+    One octave keyboard for picking the comb's active notes.
+
+  ==============================================================================
+*/
+
+#include "KeyboardComponent.h"
+
+namespace
+{
+    const char* const keyNames[] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+
+    //column of each key, white keys sit on whole columns and black keys half a column to the right
+    const int keyColumns[] = { 0, 0, 1, 1, 2, 3, 3, 4, 4, 5, 5, 6 };
+
+    bool isBlackKey(int keyIndex)
+    {
+        return keyIndex == 1 || keyIndex == 3 || keyIndex == 6 || keyIndex == 8 || keyIndex == 10;
+    }
+}
+
+KeyboardComponent::KeyboardComponent(ColourCombV4AudioProcessor& p)
+    : audioProcessor(p)
+{
+    drawnMask = audioProcessor.getActiveKeyMask();
+    startTimerHz(15);
+}
+
+KeyboardComponent::~KeyboardComponent() {}
+
+void KeyboardComponent::paint(juce::Graphics& g)
+{
+    //the image follows the physical pixel density the way setBufferedToImage does, so
+    //moving to a display with a different scale redraws it there at full resolution
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (scale != imageScale || !keyImage.isValid())
+        createKeyImage(scale);
+
+    g.drawImage(keyImage, getLocalBounds().toFloat());
+}
+
+void KeyboardComponent::resized()
+{
+    createKeyImage(imageScale);
+    repaint();
+}
+
+void KeyboardComponent::createKeyImage(float scale)
+{
+    imageScale = scale;
+    if (getWidth() <= 0 || getHeight() <= 0)
+        return;
+
+    keyImage = juce::Image(juce::Image::ARGB,
+        juce::roundToInt(getWidth() * scale), juce::roundToInt(getHeight() * scale), true);
+    renderKeys((1u << numKeys) - 1);
+}
+
+void KeyboardComponent::mouseDown(const juce::MouseEvent& event)
+{
+    const int keyIndex = getKeyAt(event.getPosition());
+    if (keyIndex >= 0 && onKeyClicked != nullptr)
+        onKeyClicked(keyIndex);
+}
+
+void KeyboardComponent::timerCallback()
+{
+    updateFromProcessor();
+}
+
+void KeyboardComponent::updateFromProcessor()
+{
+    const auto mask = audioProcessor.getActiveKeyMask();
+    const auto changedKeys = (mask ^ drawnMask) & ((1u << numKeys) - 1);
+    if (changedKeys == 0)
+        return;
+
+    drawnMask = mask;
+    renderKeys(changedKeys);
+    for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex)
+        if ((changedKeys >> keyIndex) & 1u)
+            repaint(getKeyBounds(keyIndex));
+}
+
+juce::Rectangle<int> KeyboardComponent::getKeyBounds(int keyIndex) const
+{
+    const int x = keyColumns[keyIndex] * keySpacing;
+    if (isBlackKey(keyIndex))
+        return { x + keySpacing / 2, 0, keyWidth, keyHeight };
+    return { x, whiteKeyY, keyWidth, keyHeight };
+}
+
+int KeyboardComponent::getKeyAt(juce::Point<int> position) const
+{
+    //black keys are drawn on top so they win where the two overlap
+    for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex)
+        if (isBlackKey(keyIndex) && getKeyBounds(keyIndex).contains(position))
+            return keyIndex;
+
+    for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex)
+        if (!isBlackKey(keyIndex) && getKeyBounds(keyIndex).contains(position))
+            return keyIndex;
+
+    return -1;
+}
+
+//redraws the given keys into the cached image. a white key takes any black key
+//overlapping it along, since those are drawn over it
+void KeyboardComponent::renderKeys(juce::uint32 keysToDraw)
+{
+    if (!keyImage.isValid())
+        return;
+
+    juce::uint32 blackKeysToDraw = 0;
+    for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex) {
+        if (!((keysToDraw >> keyIndex) & 1u))
+            continue;
+        if (isBlackKey(keyIndex)) {
+            blackKeysToDraw |= 1u << keyIndex;
+            continue;
+        }
+        for (int other = 0; other < numKeys; ++other)
+            if (isBlackKey(other) && getKeyBounds(other).intersects(getKeyBounds(keyIndex)))
+                blackKeysToDraw |= 1u << other;
+    }
+
+    juce::Graphics g(keyImage);
+    g.addTransform(juce::AffineTransform::scale(imageScale));
+    g.setFont(juce::FontOptions(14.0f));
+
+    auto drawKey = [this, &g](int keyIndex) {
+        const auto bounds = getKeyBounds(keyIndex);
+        const bool isActive = (drawnMask >> keyIndex) & 1u;
+        const bool isBlack = isBlackKey(keyIndex);
+
+        juce::Colour fill = isBlack ? juce::Colour(0xff2b2b2b) : juce::Colours::white;
+        if (isActive)
+            fill = isBlack ? juce::Colour(0xffc0501f) : juce::Colour(0xffff8c42);
+
+        g.setColour(fill);
+        g.fillRect(bounds);
+        g.setColour(juce::Colours::black);
+        g.drawRect(bounds, 1);
+        g.setColour(isBlack && !isActive ? juce::Colours::white : juce::Colours::black);
+        g.drawText(keyNames[keyIndex], bounds.withTrimmedTop(bounds.getHeight() - 24), juce::Justification::centred);
+    };
+
+    for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex)
+        if (!isBlackKey(keyIndex) && ((keysToDraw >> keyIndex) & 1u))
+            drawKey(keyIndex);
+
+    for (int keyIndex = 0; keyIndex < numKeys; ++keyIndex)
+        if ((blackKeysToDraw >> keyIndex) & 1u)
+            drawKey(keyIndex);
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    One octave keyboard for picking the comb's active notes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Draws the twelve keys into a cached image and shows the processor's
+    active key mask rather than keeping any toggle state of its own, so a
+    click the processor rejects (the 5 note cap, a bus follower) never leaves
+    a key lit. The image is kept at the display's pixel density and drawn
+    scaled down to the component. A low rate timer polls the atomic mask
+    and only the keys whose bit changed are redrawn and repainted.
+*/
+class KeyboardComponent : public juce::Component,
+    private juce::Timer
+{
+public:
+    explicit KeyboardComponent(ColourCombV4AudioProcessor&);
+    ~KeyboardComponent() override;
+
+    void paint(juce::Graphics&) override;
+    void resized() override;
+    void mouseDown(const juce::MouseEvent&) override;
+
+    /** Picks up the processor's mask straight away instead of waiting for the timer. */
+    void updateFromProcessor();
+
+    std::function<void(int keyIndex)> onKeyClicked;
+
+private:
+    void timerCallback() override;
+    void createKeyImage(float scale);
+    void renderKeys(juce::uint32 keysToDraw);
+    juce::Rectangle<int> getKeyBounds(int keyIndex) const;
+    int getKeyAt(juce::Point<int> position) const;
+
+    static constexpr int numKeys = 12;
+    static constexpr int keyWidth = 45;
+    static constexpr int keyHeight = 80;
+    static constexpr int keySpacing = 50;
+    static constexpr int whiteKeyY = 55;
+
+    ColourCombV4AudioProcessor& audioProcessor;
+    juce::Image keyImage;
+    float imageScale = 1.0f;
+    juce::uint32 drawnMask = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(KeyboardComponent)
+};
@@ -11,8 +11,10 @@
 
 //==============================================================================
 ColourCombV4AudioProcessorEditor::ColourCombV4AudioProcessorEditor(ColourCombV4AudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p)
+    : AudioProcessorEditor(&p), audioProcessor(p), responseCurve(p), keyboard(p)
 {
+    // Response curve first so it sits behind the knobs and keys
+    addAndMakeVisible(responseCurve);
     setSize(512, 468);
 
     // Q value knob
@@ -61,25 +63,56 @@ ColourCombV4AudioProcessorEditor::ColourCombV4AudioProcessorEditor(ColourCombV4A
     addAndMakeVisible(functionBox);
     functionBox.setSelectedId(1);
 
-    spectrumAnalyzer = juce::Rectangle<int>(40, 50, 400, 200);
+    // Scene snapshots, the scene box morphs between whatever was stored in A and B
+    sceneBox.addItem("Scene A", 1);
+    sceneBox.addItem("Scene B", 2);
+    sceneAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.parameters, "scene", sceneBox);
+    addAndMakeVisible(sceneBox);
+    storeAButton.onClick = [this] { audioProcessor.storeScaleSnapshot(0); };
+    storeBButton.onClick = [this] { audioProcessor.storeScaleSnapshot(1); };
+    addAndMakeVisible(storeAButton);
+    addAndMakeVisible(storeBButton);
+
+    // Scale bus, followers pick up the leader instance's keys
+    scaleBusBox.addItem("Bus Off", 1);
+    scaleBusBox.addItem("Bus Leader", 2);
+    scaleBusBox.addItem("Bus Follower", 3);
+    scaleBusAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.parameters, "scaleBus", scaleBusBox);
+    addAndMakeVisible(scaleBusBox);
+
+    knobFactory(5.0f, 2000.0f, 1.0f, " ms", 250.0f, morphTimeKnob);
+    addAndMakeVisible(morphTimeKnob);
+    morphTimeAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "morphTime", morphTimeKnob);
+    labelFactory("Morph", morphTimeLabel);
+    addAndMakeVisible(morphTimeLabel);
+
+    // Tuning, reference pitch plus an optional Scala scale
+    knobFactory(400.0f, 480.0f, 0.1f, " Hz", 440.0f, refPitchKnob);
+    addAndMakeVisible(refPitchKnob);
+    refPitchAttachment = std::make_unique<juce::AudioProcessorValueTreeState::SliderAttachment>(audioProcessor.parameters, "refPitch", refPitchKnob);
+    labelFactory("A4", refPitchLabel);
+    addAndMakeVisible(refPitchLabel);
+    loadTuningButton.onClick = [this] { chooseTuningFile(); };
+    resetTuningButton.onClick = [this] { audioProcessor.resetTuning(); };
+    addAndMakeVisible(loadTuningButton);
+    addAndMakeVisible(resetTuningButton);
+
+    // CPU governor, the quality box follows whatever tier the governor picked
+    qualityBox.addItem("Full", 1);
+    qualityBox.addItem("Trim", 2);
+    qualityBox.addItem("Merge", 3);
+    qualityBox.addItem("Lean", 4);
+    qualityAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(audioProcessor.parameters, "qualityTier", qualityBox);
+    addAndMakeVisible(qualityBox);
+    governorButton.setColour(juce::ToggleButton::textColourId, juce::Colours::black);
+    governorButton.setColour(juce::ToggleButton::tickColourId, juce::Colours::black);
+    governorAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(audioProcessor.parameters, "governor", governorButton);
+    addAndMakeVisible(governorButton);
 
     setOnClicks();
-    setToggleable();
-
-    // Key buttons
-    addAndMakeVisible(cKey);
-    addAndMakeVisible(dKey);
-    addAndMakeVisible(eKey);
-    addAndMakeVisible(fKey);
-    addAndMakeVisible(gKey);
-    addAndMakeVisible(aKey);
-    addAndMakeVisible(bKey);
-
-    addAndMakeVisible(cSharpKey);
-    addAndMakeVisible(dSharpKey);
-    addAndMakeVisible(fSharpKey);
-    addAndMakeVisible(gSharpKey);
-    addAndMakeVisible(aSharpKey);
+
+    // Keys, lit from the processor's key mask
+    addAndMakeVisible(keyboard);
 }
 
 ColourCombV4AudioProcessorEditor::~ColourCombV4AudioProcessorEditor(){}
@@ -97,6 +130,8 @@ void ColourCombV4AudioProcessorEditor::paint(juce::Graphics& g)
 
 void ColourCombV4AudioProcessorEditor::resized()
 {
+    responseCurve.setBounds(spectrumAnalyzer);
+
     qValKnob.setBounds(80, 40, 100, 100);
     qLabel.setBounds(80, 120, 100, 40);
 
@@ -110,24 +145,22 @@ void ColourCombV4AudioProcessorEditor::resized()
 
     functionBox.setBounds(60, 380, 200, 50);
 
-    auto xIncrement = 50;
-    auto whiteKeyXBase = 80;
-    auto whiteKeyYBase = 240;
-    auto blackKeyXBase = 105;
-    auto blackKeyYBase = 185;
-
-    cKey.setBounds(80, 240, 45, 80);
-    cSharpKey.setBounds(105, 185, 45, 80);
-    dKey.setBounds(whiteKeyXBase + xIncrement, whiteKeyYBase, 45, 80);
-    dSharpKey.setBounds(blackKeyXBase + xIncrement, blackKeyYBase, 45, 80);
-    eKey.setBounds(whiteKeyXBase + 2 * xIncrement, whiteKeyYBase, 45, 80);
-    fKey.setBounds(whiteKeyXBase + 3 * xIncrement, whiteKeyYBase, 45, 80);
-    fSharpKey.setBounds(blackKeyXBase + 3 * xIncrement, blackKeyYBase, 45, 80);
-    gKey.setBounds(whiteKeyXBase + 4 * xIncrement, whiteKeyYBase, 45, 80);
-    gSharpKey.setBounds(blackKeyXBase + 4 * xIncrement, blackKeyYBase, 45, 80);
-    aKey.setBounds(whiteKeyXBase + 5 * xIncrement, whiteKeyYBase, 45, 80);
-    aSharpKey.setBounds(blackKeyXBase + 5 * xIncrement, blackKeyYBase, 45, 80);
-    bKey.setBounds(whiteKeyXBase + 6 * xIncrement, whiteKeyYBase, 45, 80);
+    storeAButton.setBounds(290, 345, 60, 30);
+    storeBButton.setBounds(355, 345, 60, 30);
+    sceneBox.setBounds(290, 390, 125, 30);
+    scaleBusBox.setBounds(290, 430, 125, 28);
+    morphTimeKnob.setBounds(425, 335, 70, 70);
+    morphTimeLabel.setBounds(425, 400, 70, 30);
+
+    refPitchKnob.setBounds(5, 50, 70, 70);
+    refPitchLabel.setBounds(5, 115, 70, 30);
+    resetTuningButton.setBounds(368, 5, 66, 22);
+    loadTuningButton.setBounds(438, 5, 66, 22);
+
+    keyboard.setBounds(80, 185, 345, 135);
+
+    governorButton.setBounds(60, 438, 95, 24);
+    qualityBox.setBounds(160, 438, 100, 24);
 }
 
 void ColourCombV4AudioProcessorEditor::labelFactory(std::string tag, juce::Label& label) {
@@ -147,38 +180,24 @@ void ColourCombV4AudioProcessorEditor::knobFactory(float rangeFloor, float range
 
 void ColourCombV4AudioProcessorEditor::setOnClicks() {
     
-    auto setKey = [this](int keyIndex) {
+    keyboard.onKeyClicked = [this](int keyIndex) {
         audioProcessor.parameters.getParameter("key")->setValueNotifyingHost(keyIndex / 11.0f);
         audioProcessor.toggleActiveFreq(keyIndex);
         audioProcessor.updateVectorProcessorChain();
-        //figure out how to toggle the current key off if we try to press a sixth key, might need it as a parameter in the function
+        keyboard.updateFromProcessor();
     };
-
-    cKey.onClick = [setKey] { setKey(0); };
-    cSharpKey.onClick = [setKey] { setKey(1); };
-    dKey.onClick = [setKey] { setKey(2); };
-    dSharpKey.onClick = [setKey] { setKey(3); };
-    eKey.onClick = [setKey] { setKey(4); };
-    fKey.onClick = [setKey] { setKey(5); };
-    fSharpKey.onClick = [setKey] { setKey(6); };
-    gKey.onClick = [setKey] { setKey(7); };
-    gSharpKey.onClick = [setKey] { setKey(8); };
-    aKey.onClick = [setKey] { setKey(9); };
-    aSharpKey.onClick = [setKey] { setKey(10); };
-    bKey.onClick = [setKey] { setKey(11); };
 }
 
-void ColourCombV4AudioProcessorEditor::setToggleable() {
-    cKey.setClickingTogglesState(true);
-    cSharpKey.setClickingTogglesState(true);
-    dKey.setClickingTogglesState(true);
-    dSharpKey.setClickingTogglesState(true);
-    eKey.setClickingTogglesState(true);
-    fKey.setClickingTogglesState(true);
-    fSharpKey.setClickingTogglesState(true);
-    gKey.setClickingTogglesState(true);
-    gSharpKey.setClickingTogglesState(true);
-    aKey.setClickingTogglesState(true);
-    aSharpKey.setClickingTogglesState(true);
-    bKey.setClickingTogglesState(true);
-}
\ No newline at end of file
+void ColourCombV4AudioProcessorEditor::chooseTuningFile() {
+    tuningChooser = std::make_unique<juce::FileChooser>("Load a Scala tuning", juce::File(), "*.scl");
+    tuningChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+        [this](const juce::FileChooser& chooser) {
+            const auto file = chooser.getResult();
+            if (!file.existsAsFile())
+                return;
+
+            const auto result = audioProcessor.loadScalaTuning(file.loadFileAsString());
+            if (result.failed())
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "ColourComb", result.getErrorMessage());
+        });
+}
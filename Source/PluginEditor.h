@@ -10,6 +10,8 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "ResponseCurveComponent.h"
+#include "KeyboardComponent.h"
 
 //==============================================================================
 /**
@@ -27,43 +29,52 @@ public:
 private:
     ColourCombV4AudioProcessor& audioProcessor;
 
-    juce::Rectangle<int> spectrumAnalyzer;
-    juce::TextButton cKey{ "C" };
-    juce::TextButton cSharpKey{ "C#" };
-    juce::TextButton dKey{ "D" };
-    juce::TextButton dSharpKey{ "D#" };
-    juce::TextButton eKey{ "E" };
-    juce::TextButton fKey{ "F" };
-    juce::TextButton fSharpKey{ "F#" };
-    juce::TextButton gKey{ "G" };
-    juce::TextButton gSharpKey{ "G#" };
-    juce::TextButton aKey{ "A" };
-    juce::TextButton aSharpKey{ "A#" };
-    juce::TextButton bKey{ "B" };
+    juce::Rectangle<int> spectrumAnalyzer{ 40, 50, 400, 200 };
+    ResponseCurveComponent responseCurve;
+    KeyboardComponent keyboard;
 
     juce::Slider qValKnob;
     juce::Slider makeupKnob;
     juce::Slider mixKnob;
     juce::Slider focusSlider;
+    juce::Slider morphTimeKnob;
+    juce::Slider refPitchKnob;
 
     juce::Label qLabel;
     juce::Label makeupLabel;
     juce::Label mixLabel;
     juce::Label focusLabel;
+    juce::Label morphTimeLabel;
+    juce::Label refPitchLabel;
 
     juce::ComboBox functionBox;
+    juce::ComboBox sceneBox;
+    juce::ComboBox scaleBusBox;
+    juce::ComboBox qualityBox;
+    juce::ToggleButton governorButton{ "Governor" };
+    juce::TextButton storeAButton{ "Store A" };
+    juce::TextButton storeBButton{ "Store B" };
+    juce::TextButton loadTuningButton{ "Load .scl" };
+    juce::TextButton resetTuningButton{ "12-TET" };
+    std::unique_ptr<juce::FileChooser> tuningChooser;
 
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> qAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> mixAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> makeupAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> functionAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> focusAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> sceneAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> scaleBusAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> morphTimeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> refPitchAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> qualityAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> governorAttachment;
 
 
     void knobFactory(float rangeFloor, float rangeCeiling, float increments, std::string suffixVal, float defaultValue, juce::Slider& knob);
     void labelFactory(std::string tag, juce::Label& label);
     void setOnClicks();
-    void setToggleable();
+    void chooseTuningFile();
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ColourCombV4AudioProcessorEditor)
 };
\ No newline at end of file
@@ -22,14 +22,19 @@ ColourCombV4AudioProcessor::ColourCombV4AudioProcessor()
     parameters(*this, nullptr, "PARAMETERS", createParameterLayout())
 {
     parameters.addParameterListener("q", this);
-    parameters.addParameterListener("mix", this);
-    parameters.addParameterListener("makeup", this);
     parameters.addParameterListener("key", this);
     parameters.addParameterListener("qFunction", this);
     parameters.addParameterListener("focusValue", this);
+    parameters.addParameterListener("scene", this);
+    parameters.addParameterListener("refPitch", this);
+    parameters.addParameterListener("scaleBus", this);
+    parameters.addParameterListener("qualityTier", this);
+    parameters.addParameterListener("governor", this);
+
+    rebuildNoteFrequencies();
 }
 
-ColourCombV4AudioProcessor::~ColourCombV4AudioProcessor(){}
+ColourCombV4AudioProcessor::~ColourCombV4AudioProcessor(){ cancelPendingUpdate(); }
 //==============================================================================
 const juce::String ColourCombV4AudioProcessor::getName() const{return JucePlugin_Name;}
 bool ColourCombV4AudioProcessor::acceptsMidi() const
@@ -78,14 +83,46 @@ void ColourCombV4AudioProcessor::prepareToPlay(double sampleRate, int samplesPer
 
     filterChainLeft.prepare(spec);
     filterChainRight.prepare(spec);
-    
+    fadeBuffer.setSize(juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels()), samplesPerBlock);
 
-    setFrequencyBounds(400.0f, 4000.0f);
-    setTargetFrequencies(noteFrequencies[getCurrentKey()]);
+    //the table runs to nyquist, the ceiling follows it but stays below the top of the band where
+    //the notches crowd together, and below 20k where the sine Q mapping is still positive
+    setFrequencyBounds(400.0f, juce::jmin(20000.0f, (float)(sampleRate * 0.45)));
+    rebuildNoteFrequencies();
+    updateTargetFrequencies();
     updateAllFilters();
+
+    ScaleBus::StageList::Ptr notchStages;
+    if (getScaleBusMode() == ScaleBus::follower)
+        notchStages = scaleBus->getStages();
+    auto bank = buildFilterBank(captureLiveSnapshot(), notchStages);
+    if (bank != nullptr)
+        publishResponseSnapshot(makeResponseSnapshot(*bank));
+    auto spare = std::make_unique<FilterBank>();
+    spare->prepare(spec);
+    {
+        const juce::SpinLock::ScopedLockType lock(bankLock);
+        activeBank = std::move(bank);
+        spareBank = std::move(spare);
+        fadingBank.reset();
+        pendingBank.reset();
+        retiredBank.reset();
+        releasedStages.clear();
+        releasedStages.reserve(releasedStagesCapacity);
+        adoptedStages = nullptr;
+        fadePositionSamples = fadeLengthSamples = 0;
+    }
+    prepareSceneBanks();
+    governorLoad = 0.0f;
+    samplesSinceTierChange = samplesAboveStepDown = samplesBelowStepUp = 0;
 }
 
-void ColourCombV4AudioProcessor::releaseResources() {}
+void ColourCombV4AudioProcessor::releaseResources() {
+    const juce::SpinLock::ScopedLockType lock(bankLock);
+    fadingBank.reset();
+    pendingBank.reset();
+    retiredBank.reset();
+}
 
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool ColourCombV4AudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
@@ -118,24 +155,31 @@ bool ColourCombV4AudioProcessor::isBusesLayoutSupported(const BusesLayout& layou
 void ColourCombV4AudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
+    const auto blockStartTicks = juce::Time::getHighResolutionTicks();
+    pollScaleBus();
     juce::AudioBuffer<float> dryBuffer;
     dryBuffer.makeCopyOf(buffer);
 
+    //identical channels (mono source on a stereo track) only get filtered once, but not before
+    //the filters' histories agree as well. stereo material followed by identical input (digital
+    //silence, say) keeps every channel running until the other channels' tails have died down
+    bool monoInput = channelsAreIdentical(buffer);
+
     //*****fixedTemplateProcess*************
     if (useVectorChain == false) {
-        juce::dsp::AudioBlock<float> block(buffer);
-        if (buffer.getNumChannels() >= 1)
-            filterChainLeft.process(juce::dsp::ProcessContextReplacing<float>(block.getSingleChannelBlock(0)));
-        if (buffer.getNumChannels() >= 2)
-            filterChainRight.process(juce::dsp::ProcessContextReplacing<float>(block.getSingleChannelBlock(1)));
+        monoInput = monoInput && fixedChainsShareState();
+        processFixedFilterChains(buffer, monoInput);
     }
     //*******VectorChainProcess**********
     else if (useVectorChain == true) {
-        juce::dsp::AudioBlock<float> block(buffer);
-        juce::dsp::ProcessContextReplacing<float> context(block);
-        for (auto& filter : vectorProcessorChain) {
-            filter.process(context);
-        }
+        swapInPendingFilterBank();
+        monoInput = monoInput && banksShareState();
+        processFilterBanks(buffer, monoInput);
+    }
+
+    if (monoInput) {
+        for (int ch = 1; ch < buffer.getNumChannels(); ++ch)
+            buffer.copyFrom(ch, 0, buffer, 0, 0, buffer.getNumSamples());
     }
 
 
@@ -147,6 +191,127 @@ void ColourCombV4AudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     }
 
     buffer.applyGain(juce::Decibels::decibelsToGain(getMakeupGainValue()));
+
+    updateGovernor(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - blockStartTicks), buffer.getNumSamples());
+}
+
+
+
+//****************CpuGovernor**********
+//compares each block's processing time with the time the block represents. a load held
+//above the step down threshold steps one tier down, a much longer unbroken spell below the
+//step up threshold steps back up. either way the previous change has to have settled first
+void ColourCombV4AudioProcessor::updateGovernor(double elapsedSeconds, int numSamples) {
+    if (numSamples <= 0 || currentSampleRate <= 0.0)
+        return;
+
+    const double deadlineSeconds = numSamples / currentSampleRate;
+    governorLoad += 0.1f * ((float)(elapsedSeconds / deadlineSeconds) - governorLoad);
+    samplesSinceTierChange += numSamples;
+    samplesAboveStepDown = governorLoad > governorStepDownLoad ? samplesAboveStepDown + numSamples : 0;
+    samplesBelowStepUp = governorLoad < governorStepUpLoad ? samplesBelowStepUp + numSamples : 0;
+
+    if (!isGovernorEnabled() || samplesSinceTierChange < governorSettleSeconds * currentSampleRate)
+        return;
+
+    const int tier = governorTier.load();
+    int newTier = tier;
+    if (tier < numQualityTiers - 1 && samplesAboveStepDown >= governorStepDownSeconds * currentSampleRate)
+        newTier = tier + 1;
+    else if (tier > 0 && samplesBelowStepUp >= governorStepUpSeconds * currentSampleRate)
+        newTier = tier - 1;
+
+    if (newTier == tier)
+        return;
+
+    governorTier.store(newTier);
+    samplesSinceTierChange = samplesAboveStepDown = samplesBelowStepUp = 0;
+    triggerAsyncUpdate();
+}
+
+//everything the audio thread (or a host automating from it) can't do itself lands here
+void ColourCombV4AudioProcessor::handleAsyncUpdate() {
+    //parameters written from in here come back through parameterChanged, which then
+    //leaves its work for the next update instead of running this one nested
+    const juce::ScopedValueSetter<bool> handling(handlingAsyncUpdate, true);
+    collectRetiredBank();
+
+    const int recalled = recalledScene.exchange(-1);
+    if (recalled >= 0)
+        applyRecalledScene(recalled);
+
+    if (busKeysPending.exchange(false))
+        applyBusKeys();
+
+    if (noteTableStale.exchange(false))
+        rebuildNoteFrequencies();
+
+    if (sceneBanksStale.exchange(false))
+        prepareSceneBanks();
+
+    if (filtersStale.exchange(false))
+        refreshFilters();
+
+    publishGovernorTier();
+}
+
+//the tier goes through the qualityTier parameter so the host and editor see it, and the
+//rebuild it causes fades like any other bank change
+void ColourCombV4AudioProcessor::publishGovernorTier() {
+    const int tier = governorTier.load();
+    if (tier == getQualityTier())
+        return;
+
+    setParameterFromProcessor("qualityTier", (float)tier);
+}
+
+//a value the processor decided on itself, sent to the host as one gesture
+void ColourCombV4AudioProcessor::setParameterFromProcessor(const juce::String& parameterID, float value) {
+    auto* parameter = parameters.getParameter(parameterID);
+    parameter->beginChangeGesture();
+    parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    parameter->endChangeGesture();
+}
+
+bool ColourCombV4AudioProcessor::channelsAreIdentical(const juce::AudioBuffer<float>& buffer) {
+    if (buffer.getNumChannels() < 2)
+        return false;
+
+    const auto numBytes = sizeof(float) * (size_t)buffer.getNumSamples();
+    for (int ch = 1; ch < buffer.getNumChannels(); ++ch) {
+        if (std::memcmp(buffer.getReadPointer(0), buffer.getReadPointer(ch), numBytes) != 0)
+            return false;
+    }
+    return true;
+}
+
+bool ColourCombV4AudioProcessor::fixedChainsShareState() const {
+    return fixedChainWasMono || filterChainStatesMatchRecursive(filterChainLeft, filterChainRight);
+}
+
+void ColourCombV4AudioProcessor::processFixedFilterChains(juce::AudioBuffer<float>& buffer, bool monoInput) {
+    if (buffer.getNumChannels() < 1)
+        return;
+
+    //the right chain sat idle while the input was mono, its history is the left one
+    if (!monoInput && fixedChainWasMono) {
+        copyFilterChainStateRecursive(filterChainLeft, filterChainRight);
+        fixedChainWasMono = false;
+    }
+
+    juce::dsp::AudioBlock<float> block(buffer);
+    auto leftBlock = block.getSingleChannelBlock(0);
+    filterChainLeft.process(juce::dsp::ProcessContextReplacing<float>(leftBlock));
+
+    if (monoInput) {
+        fixedChainWasMono = true;
+        return;
+    }
+
+    if (buffer.getNumChannels() >= 2) {
+        auto rightBlock = block.getSingleChannelBlock(1);
+        filterChainRight.process(juce::dsp::ProcessContextReplacing<float>(rightBlock));
+    }
 }
 
 
@@ -177,7 +342,16 @@ void ColourCombV4AudioProcessor::getStateInformation(juce::MemoryBlock& destData
 void ColourCombV4AudioProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
     juce::ValueTree tree = juce::ValueTree::fromXml(juce::String::createStringFromData(data, sizeInBytes));
-    if (tree.isValid()) parameters.state = tree;
+    if (tree.isValid()) {
+        //snapshots first, replacing the state fires the scene listener
+        readScaleSnapshotsFromState(tree);
+        parameters.state = tree;
+        readTuningFromState();
+
+        //the listener only fires when the scene actually changed, so recall it regardless
+        prepareSceneBanks();
+        requestedScene.store(getCurrentScene());
+    }
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -221,6 +395,24 @@ int ColourCombV4AudioProcessor::getCurrentFunction() const {
 float ColourCombV4AudioProcessor::getFocusValue() const {
     return parameters.getRawParameterValue("focusValue")->load();
 }
+int ColourCombV4AudioProcessor::getQualityTier() const {
+    return static_cast<int>(parameters.getRawParameterValue("qualityTier")->load());
+}
+bool ColourCombV4AudioProcessor::isGovernorEnabled() const {
+    return parameters.getRawParameterValue("governor")->load() > 0.5f;
+}
+int ColourCombV4AudioProcessor::getScaleBusMode() const {
+    return static_cast<int>(parameters.getRawParameterValue("scaleBus")->load());
+}
+int ColourCombV4AudioProcessor::getCurrentScene() const {
+    return static_cast<int>(parameters.getRawParameterValue("scene")->load());
+}
+float ColourCombV4AudioProcessor::getMorphTimeValue() const {
+    return parameters.getRawParameterValue("morphTime")->load();
+}
+float ColourCombV4AudioProcessor::getReferencePitchValue() const {
+    return parameters.getRawParameterValue("refPitch")->load();
+}
 
 
 //*********EXTRA__SETTERS*****
@@ -233,21 +425,101 @@ void ColourCombV4AudioProcessor::setFrequencyBounds(float floorhz, float ceiling
     frequencyCeiling = ceilinghz;
 }
 
+void ColourCombV4AudioProcessor::updateTargetFrequencies() {
+    const int key = getCurrentKey();
+    setTargetFrequencies(key < (int)noteFrequencies.size() ? noteFrequencies[key] : std::vector<float>());
+}
+
+
+
+//**********TUNING*********
+//the only place the table is generated, nothing on the audio thread ever retunes
+void ColourCombV4AudioProcessor::rebuildNoteFrequencies() {
+    noteFrequencies = tuning.generate(getReferencePitchValue(), currentSampleRate);
+}
+
+juce::Result ColourCombV4AudioProcessor::loadScalaTuning(const juce::String& sclText) {
+    auto result = tuning.loadScala(sclText);
+    if (result.failed())
+        return result;
+
+    parameters.state.setProperty("scala", sclText, nullptr);
+    rebuildNoteFrequencies();
+    invalidateSceneBanks();
+    refreshFilters();
+    return result;
+}
+
+void ColourCombV4AudioProcessor::resetTuning() {
+    tuning.resetToEqualTemperament();
+    parameters.state.removeProperty("scala", nullptr);
+    rebuildNoteFrequencies();
+    invalidateSceneBanks();
+    refreshFilters();
+}
+
+void ColourCombV4AudioProcessor::readTuningFromState() {
+    const auto sclText = parameters.state.getProperty("scala").toString();
+    if (sclText.isEmpty() || tuning.loadScala(sclText).failed())
+        tuning.resetToEqualTemperament();
+
+    rebuildNoteFrequencies();
+    invalidateSceneBanks();
+    refreshFilters();
+}
+
 
 
 //**********AVPTS__PARAMETERS*********
 void ColourCombV4AudioProcessor::parameterChanged(const juce::String& parameterID, float newValue) {
-    if (parameterID == "q" || parameterID == "mix" || parameterID == "makeup" || parameterID == "key" || parameterID == "qFunction"
-        || parameterID == "focusValue") {
+    if (parameterID == "scene") {
+        //the scene's bank is already built, the audio thread picks it up on its next block
+        requestedScene.store(juce::jlimit(0, numScaleSnapshots - 1, static_cast<int>(newValue)));
+    }
+    else if (parameterID == "governor") {
+        //switching the governor off hands back full quality
+        if (newValue < 0.5f) {
+            governorTier.store(0);
+            triggerAsyncUpdate();
+        }
+    }
+    else if (parameterID == "scaleBus") {
+        //a new follower catches up with whatever the bus holds, a new leader publishes its keys
+        lastBusGeneration.store(0);
+        invalidateSceneBanks();
+        if (static_cast<int>(newValue) == ScaleBus::leader)
+            updateVectorProcessorChain();
+    }
+    else if (parameterID == "q" || parameterID == "key" || parameterID == "qFunction"
+        || parameterID == "focusValue" || parameterID == "refPitch" || parameterID == "qualityTier") {
+        const bool onMessageThread = juce::MessageManager::existsAndIsCurrentThread();
+        if (onMessageThread && applyingScene)
+            return;
+
         //std::cout << "Parameter changed: " << parameterID << " = " << newValue << std::endl;
         //juce::Logger::writeToLog("Q changed to: " + juce::String(getQValue()));
-        setTargetFrequencies(noteFrequencies[getCurrentKey()]);
-        if (useVectorChain) {
-            updateVectorProcessorChain();
-        }
-        else {
-            updateAllFilters();
-        }
+        //automation can arrive on the audio thread, the table and banks are only ever
+        //rebuilt on the message thread. knob moves there are handled straight away
+        if (parameterID == "refPitch")
+            noteTableStale.store(true);
+        if (parameterID == "qualityTier")
+            governorTier.store(static_cast<int>(newValue));
+        if (parameterID == "refPitch" || parameterID == "qualityTier")
+            sceneBanksStale.store(true);
+        filtersStale.store(true);
+        triggerAsyncUpdate();
+        if (onMessageThread && !handlingAsyncUpdate)
+            handleUpdateNowIfNeeded();
+    }
+}
+
+void ColourCombV4AudioProcessor::refreshFilters() {
+    updateTargetFrequencies();
+    if (useVectorChain) {
+        updateVectorProcessorChain();
+    }
+    else {
+        updateAllFilters();
     }
 }
 
@@ -261,6 +533,15 @@ juce::AudioProcessorValueTreeState::ParameterLayout ColourCombV4AudioProcessor::
     params.push_back(std::make_unique<juce::AudioParameterChoice>("qFunction", "Q Function", juce::StringArray({ "Sine", "Inv Sine" }), 0));
     //added a pushback for the layout
     params.push_back(std::make_unique <juce::AudioParameterFloat>("focusValue", "Focus Value", juce::NormalisableRange<float>(1.0f, 100.0f, 1.0f), 0.0f));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("scene", "Scene", juce::StringArray({ "A", "B" }), 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("morphTime", "Morph Time", juce::NormalisableRange<float>(5.0f, 2000.0f, 1.0f, 0.4f), 250.0f));
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("scaleBus", "Scale Bus", juce::StringArray({ "Off", "Leader", "Follower" }), 0,
+        juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    params.push_back(std::make_unique<juce::AudioParameterBool>("governor", "CPU Governor", false));
+    //set by the governor as well as the user, so it stays out of host automation like scaleBus
+    params.push_back(std::make_unique<juce::AudioParameterChoice>("qualityTier", "Quality Tier", juce::StringArray({ "Full", "Trim", "Merge", "Lean" }), 0,
+        juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>("refPitch", "Reference Pitch", juce::NormalisableRange<float>(400.0f, 480.0f, 0.1f), 440.0f));
 
     return { params.begin(), params.end() };
 }
@@ -276,14 +557,7 @@ void ColourCombV4AudioProcessor::resetFilters() {
     filterChainRight.reset();
 }
 
-void ColourCombV4AudioProcessor::updateFilterChainForChannel(
-    juce::dsp::ProcessorChain<
-    juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-    juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-    juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-    juce::dsp::IIR::Filter<float>
-    >& chain,
-    const std::vector<float>& freqs)
+void ColourCombV4AudioProcessor::updateFilterChainForChannel(FixedFilterChain& chain, const std::vector<float>& freqs)
 {
     //juce::Logger::writeToLog("function changing to: " + juce::String(getCurrentFunction()));
     updateFilterChainRecursive(chain, freqs, getSampleRate(), getQValue(), getCurrentFunction());
@@ -303,49 +577,89 @@ void ColourCombV4AudioProcessor::updateFilterChainForChannel(
 
 //****************MultiNoteUpdateVectorProcessChain**********
 void ColourCombV4AudioProcessor::updateVectorProcessorChain() {
-    vectorProcessorChain.clear();
+    queueSnapshotBank(captureLiveSnapshot(), liveFadeMilliseconds);
+}
+
+//followers run the leader's notches, leaders hand the notches they designed to the bus
+void ColourCombV4AudioProcessor::queueSnapshotBank(const ScaleSnapshot& snapshot, double fadeMilliseconds) {
+    const int busMode = getScaleBusMode();
+    ScaleBus::StageList::Ptr notchStages;
+    if (busMode == ScaleBus::follower)
+        notchStages = scaleBus->getStages();
+
+    //the response curve copy is taken here while the bank is still ours, never at handover
+    auto bank = buildFilterBank(snapshot, notchStages);
+    if (bank != nullptr)
+        publishResponseSnapshot(makeResponseSnapshot(*bank));
+    queueFilterBank(std::move(bank), fadeMilliseconds);
+
+    if (busMode == ScaleBus::leader)
+        scaleBus->publish(notchStages);
+}
+
+ScaleBus::StageList::Ptr ColourCombV4AudioProcessor::makeNotchStages(const ScaleSnapshot& snapshot) const {
+    ScaleBus::StageList::Ptr notchStages = new ScaleBus::StageList();
+    notchStages->sampleRate = spec.sampleRate;
+    notchStages->keyMask = maskFromKeys(snapshot.activeFreqs);
+
+    //lower quality tiers drop high octaves and, from Merge on, fold neighbouring notches together
+    const int tier = getQualityTier();
+    const float tierCeiling = frequencyCeiling / (tier >= 3 ? 4.0f : tier >= 1 ? 2.0f : 1.0f);
+    std::vector<std::pair<float, float>> notches;
+
     //filter through the thirteen possible keynotes
-    for (int keyIndex = 0; keyIndex < activeFreqs.size(); ++keyIndex) {
+    for (int keyIndex = 0; keyIndex < snapshot.activeFreqs.size() && keyIndex < noteFrequencies.size(); ++keyIndex) {
         //if a key note is 1, active, we create a filter for its harmonics
-        if (activeFreqs[keyIndex] == 1) {
-            //loop thorugh all the possible harmonics that we have stored in the noteFrequencyTable
-            for (int harmonicIndex = 0; harmonicIndex < 6; ++harmonicIndex) {
+        if (snapshot.activeFreqs[keyIndex] == 1) {
+            //loop thorugh all the possible harmonics that we have stored in the noteFrequencyTable, it already stops at nyquist
+            for (int harmonicIndex = 0; harmonicIndex < noteFrequencies[keyIndex].size(); ++harmonicIndex) {
                 auto specificFreq = noteFrequencies[keyIndex][harmonicIndex];
 
                 //so long as the harmonic is range make a filter for it
-                if (frequencyFloor <= specificFreq && specificFreq <= frequencyCeiling) {
+                if (frequencyFloor <= specificFreq && specificFreq <= tierCeiling) {
                     // Add filter for this specificFreq here
-                    float qratio = getQValue();
+                    float qratio = snapshot.q;
                     float q = 10;
-                    auto pi = juce::MathConstants<float>::pi;
-                    if (getCurrentFunction() == 0) {
+                    if (snapshot.function == 0) {
                      
                         float freqMapping = (900 * std::sin((juce::MathConstants<float>::pi * specificFreq) / 44100.0f)) / qratio;
                         q = juce::jlimit(1.0f, 50.0f, freqMapping);
                  
                     }
-                    else if (getCurrentFunction() == 1) {
+                    else if (snapshot.function == 1) {
                     
                         float freqMapping = (900 * (-1 * std::sin((juce::MathConstants<float>::pi * specificFreq)) / 44100.0f)) / qratio;
                         q = juce::jlimit(1.0f, 50.0f, freqMapping);
                     }
-                    juce::dsp::ProcessorDuplicator<
-                        juce::dsp::IIR::Filter<float>,
-                        juce::dsp::IIR::Coefficients<float>> newFilter;
-                    auto coeffs = juce::dsp::IIR::Coefficients<float>::makeNotch(getSampleRate(), specificFreq, q);
-                    *newFilter.state = *coeffs;
-                    newFilter.prepare(spec);
-                    vectorProcessorChain.push_back(std::move(newFilter));
+                    notches.push_back({ specificFreq, q });
                 }
             }
         }
     }
+
+    if (tier >= 2)
+        mergeAdjacentNotches(notches);
+    for (const auto& notch : notches)
+        notchStages->notches.push_back(juce::dsp::IIR::Coefficients<float>::makeNotch(spec.sampleRate, notch.first, notch.second));
+    notchStages->notchSpecs = std::move(notches);
+    return notchStages;
+}
+
+//followers pass in the leader's notches and run them as they are, unless they were designed
+//for another sample rate. otherwise the notches are designed here and handed back
+std::unique_ptr<ColourCombV4AudioProcessor::FilterBank> ColourCombV4AudioProcessor::buildFilterBank(const ScaleSnapshot& snapshot, ScaleBus::StageList::Ptr& notchStages) const {
+    if (spec.sampleRate <= 0.0)
+        return nullptr;
+
+    if (notchStages == nullptr || notchStages->sampleRate != spec.sampleRate)
+        notchStages = makeNotchStages(snapshot);
+
+    auto bank = std::make_unique<FilterBank>();
+    for (const auto& notch : notchStages->notches)
+        bank->addStage(notch);
     //high and low shelf filters go here
     
-    juce::dsp::ProcessorDuplicator<
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Coefficients<float>> newFilter;
-    float focusVal = getFocusValue();
+    float focusVal = snapshot.focus;
     constexpr float maxCutDb = -60.0f;     // tweak to taste (e.g., -24, -36)
     constexpr float gamma = 1.4f;       // response shaping
 
@@ -354,26 +668,387 @@ void ColourCombV4AudioProcessor::updateVectorProcessorChain() {
   
 
     //auto coeffs = juce::dsp::IIR::Coefficients<float>::makeHighPass(getSampleRate()* (focusVal / 100.f), 200.f);
-    auto coeffs = juce::dsp::IIR::Coefficients<float>::makeLowShelf(getSampleRate(), 200.f, 1.0f, cutDb);
-    *newFilter.state = *coeffs;
-    newFilter.prepare(spec);
-    vectorProcessorChain.push_back(std::move(newFilter));
+    bank->addStage(juce::dsp::IIR::Coefficients<float>::makeLowShelf(spec.sampleRate, 200.f, 1.0f, cutDb));
     
     
-    juce::dsp::ProcessorDuplicator<
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Coefficients<float>> highShelfFilter;
     //coeffs = juce::dsp::IIR::Coefficients<float>::makeLowPass(getSampleRate()*(focusVal/100.f), 11000.f);
-    coeffs = juce::dsp::IIR::Coefficients<float>::makeHighShelf(getSampleRate(), 11000.f, 1.0f, cutDb);
-    *highShelfFilter.state = *coeffs;
-    highShelfFilter.prepare(spec);
-    vectorProcessorChain.push_back(std::move(highShelfFilter));
+    bank->addStage(juce::dsp::IIR::Coefficients<float>::makeHighShelf(spec.sampleRate, 11000.f, 1.0f, cutDb));
+
+    bank->prepare(spec);
+    return bank;
+}
 
+//notches less than a semitone and a half apart become one wider notch spanning both
+void ColourCombV4AudioProcessor::mergeAdjacentNotches(std::vector<std::pair<float, float>>& notches) {
+    const float mergeRatio = std::pow(2.0f, 1.5f / 12.0f);
+    std::sort(notches.begin(), notches.end());
 
+    std::vector<std::pair<float, float>> merged;
+    for (const auto& notch : notches) {
+        if (merged.empty() || notch.first > merged.back().first * mergeRatio) {
+            merged.push_back(notch);
+            continue;
+        }
+
+        auto& previous = merged.back();
+        const float lowEdge = previous.first - previous.first / (2.0f * previous.second);
+        const float highEdge = notch.first + notch.first / (2.0f * notch.second);
+        const float centre = std::sqrt(previous.first * notch.first);
+        previous = { centre, juce::jlimit(0.5f, 50.0f, centre / (highEdge - lowEdge)) };
+    }
+    notches = std::move(merged);
 }
 
+void ColourCombV4AudioProcessor::FilterBank::addStage(CombBiquad::CoefficientsPtr coefficients) {
+    stages.push_back(std::move(coefficients));
+}
+
+//room for maxPreparedStages is reserved up front so a follower can refill the bank
+//on the audio thread later without allocating
+void ColourCombV4AudioProcessor::FilterBank::prepare(const juce::dsp::ProcessSpec& processSpec) {
+    const auto capacity = juce::jmax(maxPreparedStages, stages.size());
+    stages.reserve(capacity);
+    channels.clear();
+    channels.resize(processSpec.numChannels);
+    for (auto& channel : channels)
+        channel.reserve(capacity);
+    resetChannels();
+}
+
+//fresh biquads for the current stages, within the reserved capacity
+void ColourCombV4AudioProcessor::FilterBank::resetChannels() {
+    for (auto& channel : channels) {
+        channel.clear();
+        for (auto& coefficients : stages)
+            channel.emplace_back(coefficients);
+    }
+    wasMono = false;
+}
+
+bool ColourCombV4AudioProcessor::FilterBank::canHold(size_t numStages) const {
+    if (numStages > stages.capacity())
+        return false;
+    for (const auto& channel : channels)
+        if (numStages > channel.capacity())
+            return false;
+    return true;
+}
+
+//while mono only channel 0's state is kept, the others take it over when the input splits
+bool ColourCombV4AudioProcessor::FilterBank::channelsShareState() const {
+    if (wasMono)
+        return true;
+
+    for (size_t ch = 1; ch < channels.size(); ++ch)
+        for (size_t stage = 0; stage < stages.size(); ++stage)
+            if (!channels[ch][stage].hasSameStateAs(channels[0][stage]))
+                return false;
+    return true;
+}
+
+void ColourCombV4AudioProcessor::FilterBank::process(juce::dsp::AudioBlock<float>& block, bool monoInput) {
+    const auto numChannels = juce::jmin(block.getNumChannels(), channels.size());
+    if (numChannels == 0)
+        return;
+
+    //channels other than 0 skipped the mono blocks, so they take over channel 0's history
+    if (!monoInput && wasMono) {
+        for (size_t ch = 1; ch < numChannels; ++ch)
+            for (size_t stage = 0; stage < stages.size(); ++stage)
+                channels[ch][stage].copyStateFrom(channels[0][stage]);
+    }
+    wasMono = monoInput;
+
+    const auto numChannelsToFilter = monoInput ? (size_t)1 : numChannels;
+    for (size_t ch = 0; ch < numChannelsToFilter; ++ch) {
+        auto channelBlock = block.getSingleChannelBlock(ch);
+        juce::dsp::ProcessContextReplacing<float> context(channelBlock);
+        for (auto& filter : channels[ch])
+            filter.process(context);
+    }
+}
+
+
+
+
+//****************BankCrossfade**********
+//new banks never replace the running one in place, they are faded in over fadeMilliseconds
+//with the old bank still running alongside. outside of a fade only one bank costs anything
+void ColourCombV4AudioProcessor::queueFilterBank(std::unique_ptr<FilterBank> bank, double fadeMilliseconds) {
+    if (bank == nullptr)
+        return;
+
+    std::unique_ptr<FilterBank> retired;
+    {
+        const juce::SpinLock::ScopedLockType lock(bankLock);
+        retired = std::move(retiredBank);
+        std::swap(pendingBank, bank);
+        pendingFadeSamples = juce::roundToInt(fadeMilliseconds * 0.001 * spec.sampleRate);
+    }
+    //the replaced pending bank and the retired one are freed here, outside the lock
+}
+
+void ColourCombV4AudioProcessor::collectRetiredBank() {
+    std::unique_ptr<FilterBank> retired;
+    std::vector<CombBiquad::CoefficientsPtr> released;
+    released.reserve(releasedStagesCapacity);
+    {
+        const juce::SpinLock::ScopedLockType lock(bankLock);
+        retired = std::move(retiredBank);
+        std::swap(released, releasedStages);
+    }
+    //freed here, outside the lock
+}
+
+void ColourCombV4AudioProcessor::swapInPendingFilterBank() {
+    const juce::SpinLock::ScopedTryLockType lock(bankLock);
+    if (!lock.isLocked())
+        return;
+
+    //a finished fade becomes a follower's spare, or is parked for handleAsyncUpdate to free.
+    //if the previous one hasn't been collected yet it stays put and asks again, either way the
+    //next transition doesn't depend on some unrelated rebuild coming along
+    if (fadingBank != nullptr && fadePositionSamples >= fadeLengthSamples) {
+        if (spareBank == nullptr && getScaleBusMode() == ScaleBus::follower) {
+            spareBank = std::move(fadingBank);
+        }
+        else {
+            if (retiredBank == nullptr)
+                retiredBank = std::move(fadingBank);
+            triggerAsyncUpdate();
+        }
+    }
+
+    //one transition at a time, anything queued meanwhile waits for the current fade to end
+    if (fadingBank != nullptr)
+        return;
+
+    //a scene change takes its prepared bank, the message thread then applies the scene's
+    //keys and builds the slot a fresh bank. nothing is built or freed here
+    int scene = requestedScene.load();
+    if (pendingBank == nullptr && scene >= 0 && sceneBanks[(size_t)scene] != nullptr) {
+        pendingBank = std::move(sceneBanks[(size_t)scene]);
+        pendingFadeSamples = juce::roundToInt(getMorphTimeValue() * 0.001 * spec.sampleRate);
+        requestedScene.compare_exchange_strong(scene, -1);
+        recalledScene.store(scene);
+        sceneBanksStale.store(true);
+        triggerAsyncUpdate();
+    }
+
+    if (pendingBank == nullptr)
+        return;
+
+    if (activeBank != nullptr) {
+        fadingBank = std::move(activeBank);
+        fadeLengthSamples = juce::jmax(1, pendingFadeSamples);
+        fadePositionSamples = 0;
+    }
+    activeBank = std::move(pendingBank);
+}
+
+bool ColourCombV4AudioProcessor::banksShareState() const {
+    const bool isFading = fadingBank != nullptr && fadePositionSamples < fadeLengthSamples;
+    return (activeBank == nullptr || activeBank->channelsShareState())
+        && (!isFading || fadingBank->channelsShareState());
+}
+
+//swapInPendingFilterBank has already run for this block, processBlock needs the banks settled
+//before it decides whether the block can be filtered as mono
+void ColourCombV4AudioProcessor::processFilterBanks(juce::AudioBuffer<float>& buffer, bool monoInput) {
+    //with mono input only channel 0 is filtered and faded, processBlock copies it out after
+    const int numChannels = monoInput ? 1 : buffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    const bool isFading = fadingBank != nullptr && fadePositionSamples < fadeLengthSamples;
+
+    if (isFading) {
+        if (fadeBuffer.getNumChannels() < numChannels || fadeBuffer.getNumSamples() < numSamples)
+            fadeBuffer.setSize(numChannels, numSamples, false, false, true);
+        for (int ch = 0; ch < numChannels; ++ch)
+            fadeBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+    }
+
+    juce::dsp::AudioBlock<float> block(buffer);
+    if (activeBank != nullptr)
+        activeBank->process(block, monoInput);
+
+    if (!isFading)
+        return;
+
+    auto fadeBlock = juce::dsp::AudioBlock<float>(fadeBuffer).getSubsetChannelBlock(0, (size_t)numChannels).getSubBlock(0, (size_t)numSamples);
+    fadingBank->process(fadeBlock, monoInput);
+
+    //equal power: incoming bank on sin, outgoing bank on cos
+    const float halfPi = juce::MathConstants<float>::halfPi;
+    for (int i = 0; i < numSamples; ++i) {
+        const float progress = juce::jmin(1.0f, (float)(fadePositionSamples + i) / (float)fadeLengthSamples);
+        const float newGain = std::sin(progress * halfPi);
+        const float oldGain = std::cos(progress * halfPi);
+        for (int ch = 0; ch < numChannels; ++ch) {
+            auto* wet = buffer.getWritePointer(ch);
+            wet[i] = wet[i] * newGain + fadeBuffer.getSample(ch, i) * oldGain;
+        }
+    }
+    fadePositionSamples += numSamples;
+}
+
+
+
+
+ColourCombV4AudioProcessor::ResponseSnapshot ColourCombV4AudioProcessor::makeResponseSnapshot(const FilterBank& bank) const {
+    ResponseSnapshot snapshot;
+    snapshot.sampleRate = spec.sampleRate;
+    snapshot.biquads.reserve(bank.stages.size());
+    for (const auto& stage : bank.stages) {
+        const auto* c = stage->getRawCoefficients();
+        snapshot.biquads.push_back({ c[0], c[1], c[2], c[3], c[4] });
+    }
+    return snapshot;
+}
+
+void ColourCombV4AudioProcessor::publishResponseSnapshot(ResponseSnapshot snapshot) {
+    {
+        const juce::SpinLock::ScopedLockType lock(responseLock);
+        std::swap(responseSnapshot, snapshot);
+    }
+    ++responseGeneration;
+}
+
+ColourCombV4AudioProcessor::ResponseSnapshot ColourCombV4AudioProcessor::getResponseSnapshot() const {
+    const juce::SpinLock::ScopedLockType lock(responseLock);
+    return responseSnapshot;
+}
+
+
+
+
+//****************ScaleSnapshots**********
+ColourCombV4AudioProcessor::ScaleSnapshot ColourCombV4AudioProcessor::captureLiveSnapshot() const {
+    ScaleSnapshot snapshot;
+    snapshot.activeFreqs = activeFreqs;
+    snapshot.q = getQValue();
+    snapshot.function = getCurrentFunction();
+    snapshot.focus = getFocusValue();
+    snapshot.isStored = true;
+    return snapshot;
+}
+
+void ColourCombV4AudioProcessor::storeScaleSnapshot(int slot) {
+    if (slot < 0 || slot >= numScaleSnapshots)
+        return;
+    scaleSnapshots[slot] = captureLiveSnapshot();
+    writeScaleSnapshotsToState();
+    prepareSceneBanks();
+}
+
+bool ColourCombV4AudioProcessor::hasScaleSnapshot(int slot) const {
+    return slot >= 0 && slot < numScaleSnapshots && scaleSnapshots[slot].isStored;
+}
+
+//message thread only. rebuilds the bank of every stored scene, followers build theirs
+//with the keys and notches the bus gave them
+void ColourCombV4AudioProcessor::prepareSceneBanks() {
+    const bool isFollower = getScaleBusMode() == ScaleBus::follower;
+    std::array<std::unique_ptr<FilterBank>, numScaleSnapshots> banks;
+    for (int slot = 0; slot < numScaleSnapshots; ++slot) {
+        sceneStages[slot] = nullptr;
+        sceneResponses[slot] = {};
+        if (!hasScaleSnapshot(slot))
+            continue;
+
+        auto snapshot = scaleSnapshots[slot];
+        if (isFollower) {
+            snapshot.activeFreqs = activeFreqs;
+            sceneStages[slot] = scaleBus->getStages();
+        }
+        banks[slot] = buildFilterBank(snapshot, sceneStages[slot]);
+        if (banks[slot] != nullptr)
+            sceneResponses[slot] = makeResponseSnapshot(*banks[slot]);
+    }
+
+    {
+        const juce::SpinLock::ScopedLockType lock(bankLock);
+        std::swap(sceneBanks, banks);
+    }
+    //the banks they replace are freed here, outside the lock
+}
+
+//safe from any thread, the rebuild happens in handleAsyncUpdate
+void ColourCombV4AudioProcessor::invalidateSceneBanks() {
+    sceneBanksStale.store(true);
+    triggerAsyncUpdate();
+}
+
+//runs once the audio thread has handed the scene's bank over. the recalled keys, Q, function
+//and focus become the live ones, so the next rebuild doesn't quietly revert to the old knob
+//values. the bank already matches them, writing them back doesn't rebuild it again.
+//followers keep the keys the bus gave them, leaders pass the new ones on
+void ColourCombV4AudioProcessor::applyRecalledScene(int slot) {
+    if (!hasScaleSnapshot(slot))
+        return;
+
+    const auto& snapshot = scaleSnapshots[slot];
+    applyingScene = true;
+    setParameterFromProcessor("q", snapshot.q);
+    setParameterFromProcessor("qFunction", (float)snapshot.function);
+    setParameterFromProcessor("focusValue", snapshot.focus);
+    applyingScene = false;
+
+    publishResponseSnapshot(sceneResponses[slot]);
+    const int busMode = getScaleBusMode();
+    if (busMode == ScaleBus::follower)
+        return;
+
+    setActiveKeyMask(maskFromKeys(snapshot.activeFreqs));
+    if (busMode == ScaleBus::leader)
+        scaleBus->publish(sceneStages[slot]);
+}
+
+void ColourCombV4AudioProcessor::writeScaleSnapshotsToState() {
+    auto snapshots = parameters.state.getOrCreateChildWithName("SNAPSHOTS", nullptr);
+    snapshots.removeAllChildren(nullptr);
+    for (int slot = 0; slot < numScaleSnapshots; ++slot) {
+        const auto& snapshot = scaleSnapshots[slot];
+        if (!snapshot.isStored)
+            continue;
+
+        juce::String keys;
+        for (auto key : snapshot.activeFreqs)
+            keys << key;
+
+        juce::ValueTree child("SNAPSHOT");
+        child.setProperty("slot", slot, nullptr);
+        child.setProperty("keys", keys, nullptr);
+        child.setProperty("q", snapshot.q, nullptr);
+        child.setProperty("function", snapshot.function, nullptr);
+        child.setProperty("focus", snapshot.focus, nullptr);
+        snapshots.appendChild(child, nullptr);
+    }
+}
+
+void ColourCombV4AudioProcessor::readScaleSnapshotsFromState(const juce::ValueTree& state) {
+    scaleSnapshots = {};
+    auto snapshots = state.getChildWithName("SNAPSHOTS");
+    for (const auto& child : snapshots) {
+        const int slot = child.getProperty("slot", -1);
+        if (slot < 0 || slot >= numScaleSnapshots)
+            continue;
+
+        auto& snapshot = scaleSnapshots[slot];
+        const auto keys = child.getProperty("keys").toString();
+        for (int i = 0; i < keys.length() && i < snapshot.activeFreqs.size(); ++i)
+            snapshot.activeFreqs[i] = keys[i] == '1' ? 1 : 0;
+        snapshot.q = child.getProperty("q", 20.0f);
+        snapshot.function = child.getProperty("function", 0);
+        snapshot.focus = child.getProperty("focus", 0.0f);
+        snapshot.isStored = true;
+    }
+}
 
 void ColourCombV4AudioProcessor::toggleActiveFreq(int x) {
+    //followers take their keys from the scale bus only
+    if (getScaleBusMode() == ScaleBus::follower)
+        return;
+
     if (activeFreqs[x] == 0 && numOfActiveFreqs < 5) {
         activeFreqs[x] = 1;
         numOfActiveFreqs++;
@@ -382,4 +1057,117 @@ void ColourCombV4AudioProcessor::toggleActiveFreq(int x) {
         activeFreqs[x] = 0;
         numOfActiveFreqs--;
     }
+    activeKeyMask.store(maskFromKeys(activeFreqs));
+}
+
+juce::uint32 ColourCombV4AudioProcessor::getActiveKeyMask() const {
+    return activeKeyMask.load();
+}
+
+juce::uint32 ColourCombV4AudioProcessor::maskFromKeys(const std::vector<int>& keys) {
+    juce::uint32 mask = 0;
+    for (int i = 0; i < (int)keys.size() && i < 32; ++i)
+        if (keys[i] == 1)
+            mask |= 1u << i;
+    return mask;
+}
+
+void ColourCombV4AudioProcessor::setActiveKeyMask(juce::uint32 mask) {
+    for (int i = 0; i < (int)activeFreqs.size(); ++i)
+        activeFreqs[i] = (mask >> i) & 1u ? 1 : 0;
+    numOfActiveFreqs = (int)std::count(activeFreqs.begin(), activeFreqs.end(), 1);
+    activeKeyMask.store(mask);
+}
+
+
+
+//****************ScaleBus**********
+//runs at the top of every block. one atomic load when nothing changed. when the leader
+//published, its stage list is adopted right here at the block boundary; anything that can't
+//be taken yet (the leader mid publish, a fade still running) is simply retried next block.
+//the message thread only catches the keys up for the editor and the scene banks afterwards
+void ColourCombV4AudioProcessor::pollScaleBus() {
+    if (getScaleBusMode() != ScaleBus::follower)
+        return;
+
+    const auto generation = ScaleBus::generationOf(scaleBus->getState());
+    const auto lastGeneration = lastBusGeneration.load();
+    if (generation == 0 || generation == lastGeneration)
+        return;
+
+    ScaleBus::StageList::Ptr stages;
+    if (!scaleBus->tryGetStages(stages) || stages == nullptr)
+        return;
+
+    //a freshly switched on follower (lastGeneration 0) always takes the list over
+    if (stages != adoptedStages || lastGeneration == 0) {
+        //designed for another rate, or more notches than a prepared bank holds: this
+        //instance designs its own from the keys on the message thread instead
+        const bool fits = stages->sampleRate == spec.sampleRate
+            && stages->notches.size() + FilterBank::numShelfStages <= FilterBank::maxPreparedStages;
+        if (!fits)
+            busRebuildPending.store(true);
+        else if (!adoptBusStages(*stages))
+            return;
+
+        adoptedStages = stages;
+        activeKeyMask.store(stages->keyMask);
+        busKeyMask.store(stages->keyMask);
+        busKeysPending.store(true);
+        triggerAsyncUpdate();
+    }
+    lastBusGeneration.store(generation);
+    //stages only drops a count here, the bus keeps every published list alive
+}
+
+//audio thread. refills the spare bank with the leader's notches plus this instance's own
+//shelves from the running bank and queues it like any other bank. nothing is allocated or
+//freed: the vectors were reserved in prepare and the references the spare lets go of are
+//parked in releasedStages until collectRetiredBank picks them up
+bool ColourCombV4AudioProcessor::adoptBusStages(const ScaleBus::StageList& stages) {
+    const juce::SpinLock::ScopedTryLockType lock(bankLock);
+    if (!lock.isLocked() || spareBank == nullptr || activeBank == nullptr || pendingBank != nullptr || fadingBank != nullptr)
+        return false;
+
+    auto& bank = *spareBank;
+    const auto numStages = stages.notches.size() + FilterBank::numShelfStages;
+    if (activeBank->stages.size() < FilterBank::numShelfStages || !bank.canHold(numStages))
+        return false;
+
+    if (releasedStages.size() + bank.stages.size() > releasedStages.capacity()) {
+        triggerAsyncUpdate();
+        return false;
+    }
+
+    for (auto& stage : bank.stages)
+        releasedStages.push_back(std::move(stage));
+    bank.stages.clear();
+    for (const auto& notch : stages.notches)
+        bank.stages.push_back(notch);
+    for (auto i = activeBank->stages.size() - FilterBank::numShelfStages; i < activeBank->stages.size(); ++i)
+        bank.stages.push_back(activeBank->stages[i]);
+    bank.resetChannels();
+
+    pendingBank = std::move(spareBank);
+    pendingFadeSamples = juce::roundToInt(liveFadeMilliseconds * 0.001 * spec.sampleRate);
+    return true;
+}
+
+//message thread. the audio thread already runs the leader's notches, this brings activeFreqs,
+//the response curve and the scene banks in line. a list this instance couldn't adopt is
+//rebuilt here from the keys instead
+void ColourCombV4AudioProcessor::applyBusKeys() {
+    if (getScaleBusMode() != ScaleBus::follower)
+        return;
+
+    setActiveKeyMask(busKeyMask.load());
+    sceneBanksStale.store(true);
+    if (busRebuildPending.exchange(false)) {
+        filtersStale.store(true);
+        return;
+    }
+
+    auto notchStages = scaleBus->getStages();
+    if (auto bank = buildFilterBank(captureLiveSnapshot(), notchStages))
+        publishResponseSnapshot(makeResponseSnapshot(*bank));
 }
\ No newline at end of file
@@ -14,13 +14,24 @@
 /**
 */
 #include <vector>
+#include <array>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include "CombBiquad.h"
+#include "TuningTable.h"
+#include "ScaleBus.h"
+
+//seven biquads per channel for the fixed template path
+using FixedFilterChain = juce::dsp::ProcessorChain<CombBiquad, CombBiquad, CombBiquad,
+    CombBiquad, CombBiquad, CombBiquad, CombBiquad>;
 
 //==============================================================================
 /**
 */
 class ColourCombV4AudioProcessor : public juce::AudioProcessor,
-    public juce::AudioProcessorValueTreeState::Listener
+    public juce::AudioProcessorValueTreeState::Listener,
+    private juce::AsyncUpdater
 {
 public:
     ColourCombV4AudioProcessor();
@@ -65,6 +76,12 @@ public:
     int getCurrentKey() const;
     int getCurrentFunction() const;
     float getFocusValue() const;
+    int getCurrentScene() const;
+    float getMorphTimeValue() const;
+    float getReferencePitchValue() const;
+    int getScaleBusMode() const;
+    int getQualityTier() const;
+    bool isGovernorEnabled() const;
 
     void setTargetFrequencies(const std::vector<float>& freqs);
     void setFrequencyBounds(float floorhz, float ceilinghz);
@@ -73,17 +90,45 @@ public:
     void parameterChanged(const juce::String& parameterID, float newValue) override;
     std::vector<int> activeFreqs = { 0,0,0,0,0,0,0,0,0,0,0,0,0 };
     void toggleActiveFreq(int x);
+    juce::uint32 getActiveKeyMask() const;
     int numOfActiveFreqs = 1;
     void updateVectorProcessorChain();
-    juce::dsp::ProcessSpec spec;
-    
+    juce::dsp::ProcessSpec spec{};
+
+    //scale snapshots (A/B scenes), morphed between with the "scene" parameter
+    struct ScaleSnapshot
+    {
+        std::vector<int> activeFreqs = { 0,0,0,0,0,0,0,0,0,0,0,0,0 };
+        float q = 20.0f;
+        int function = 0;
+        float focus = 0.0f;
+        bool isStored = false;
+    };
+    static constexpr int numScaleSnapshots = 2;
+    void storeScaleSnapshot(int slot);
+    bool hasScaleSnapshot(int slot) const;
+
+    //copy of the newest bank's biquad coefficients (b0 b1 b2 a1 a2) for the editor's
+    //response curve. taken where the bank is built, the live filters are never read from
+    //outside the audio thread
+    struct ResponseSnapshot
+    {
+        double sampleRate = 0.0;
+        std::vector<std::array<float, 5>> biquads;
+    };
+    ResponseSnapshot getResponseSnapshot() const;
+    juce::uint32 getResponseGeneration() const { return responseGeneration.load(); }
+
+    //tuning, a Scala file replaces 12-TET until resetTuning is called
+    juce::Result loadScalaTuning(const juce::String& sclText);
+    void resetTuning();
+
 
 private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ColourCombV4AudioProcessor)
 
-        juce::dsp::ProcessorChain<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Filter<float>> filterChainLeft, filterChainRight;
+        FixedFilterChain filterChainLeft, filterChainRight;
+    bool fixedChainWasMono = false;
    
 
     float thingy = 100.f;
@@ -94,32 +139,130 @@ private:
 
     void updateAllFilters();
     void resetFilters();
-    void updateFilterChainForChannel(
-        juce::dsp::ProcessorChain<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Filter<float>>&chain,
-        const std::vector<float>& freqs);
-
-    std::vector<std::vector<float>> noteFrequencies = {
-        {130.81f, 261.63f, 523.25f, 1046.50f, 2093.00f, 4186.01f, 8372.02f},
-        {138.59f, 277.18f, 554.37f, 1108.73f, 2217.46f, 4434.92f, 8869.84f},
-        {146.83f, 293.66f, 587.33f, 1174.66f, 2349.32f, 4698.64f, 9397.27f},
-        {155.56f, 311.13f, 622.25f, 1244.51f, 2489.02f, 4978.03f, 9956.06f},
-        {164.81f, 329.63f, 659.26f, 1318.51f, 2637.02f, 5274.04f, 10548.08f},
-        {174.61f, 349.23f, 698.46f, 1396.91f, 2793.83f, 5587.65f, 11175.30f},
-        {185.00f, 369.99f, 739.99f, 1479.98f, 2959.96f, 5919.91f, 11839.82f},
-        {196.00f, 392.00f, 783.99f, 1567.98f, 3135.96f, 6271.93f, 12543.86f},
-        {207.65f, 415.30f, 830.61f, 1661.22f, 3322.44f, 6644.88f, 13289.75f},
-        {220.00f, 440.00f, 880.00f, 1760.00f, 3520.00f, 7040.00f, 14080.00f},
-        {233.08f, 466.16f, 932.33f, 1864.66f, 3729.31f, 7458.62f, 14917.24f},
-        {246.94f, 493.88f, 987.77f, 1975.53f, 3951.07f, 7902.13f, 15804.26f}
-    };
+    void updateFilterChainForChannel(FixedFilterChain& chain, const std::vector<float>& freqs);
+    void processFixedFilterChains(juce::AudioBuffer<float>& buffer, bool monoInput);
+    bool fixedChainsShareState() const;
+    static bool channelsAreIdentical(const juce::AudioBuffer<float>& buffer);
+
+    //one row per scale degree starting at C3, one column per octave up to nyquist.
+    //regenerated in prepareToPlay and, on the message thread, when the reference pitch or tuning changes
+    std::vector<std::vector<float>> noteFrequencies;
+    TuningTable tuning;
+    void rebuildNoteFrequencies();
+    void updateTargetFrequencies();
+    void refreshFilters();
+    void readTuningFromState();
+    std::atomic<bool> noteTableStale{ false };
+    std::atomic<bool> filtersStale{ false };
 
     //vector chain for multiplenotes
     bool useVectorChain = true;  // Set this from UI or private test toggle
-    std::vector<juce::dsp::ProcessorDuplicator<
-        juce::dsp::IIR::Filter<float>,
-        juce::dsp::IIR::Coefficients<float>>> vectorProcessorChain;
+    //every stage shares one coefficient set across the per channel biquads. when the
+    //input is mono only channel 0 runs, the others pick up its state once it goes stereo.
+    //the last two stages are always the focus shelves
+    struct FilterBank
+    {
+        static constexpr size_t maxPreparedStages = 256;
+        static constexpr size_t numShelfStages = 2;
+
+        std::vector<CombBiquad::CoefficientsPtr> stages;
+        std::vector<std::vector<CombBiquad>> channels;
+        bool wasMono = false;
+
+        void addStage(CombBiquad::CoefficientsPtr coefficients);
+        void prepare(const juce::dsp::ProcessSpec& processSpec);
+        void resetChannels();
+        bool canHold(size_t numStages) const;
+        void process(juce::dsp::AudioBlock<float>& block, bool monoInput);
+        bool channelsShareState() const;
+    };
+
+    //banks are built off the audio thread and handed over through pendingBank.
+    //while a fade runs the previous bank keeps processing as fadingBank, once the
+    //fade is done it is parked in retiredBank and freed from handleAsyncUpdate
+    std::unique_ptr<FilterBank> activeBank, fadingBank, pendingBank, retiredBank;
+    juce::SpinLock bankLock;
+    int pendingFadeSamples = 0;
+    int fadeLengthSamples = 0;
+    int fadePositionSamples = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+    static constexpr double liveFadeMilliseconds = 30.0;
+
+    std::array<ScaleSnapshot, numScaleSnapshots> scaleSnapshots;
+
+    //every stored scene keeps a bank built ahead on the message thread. a scene change
+    //(which hosts may automate from the audio thread) only asks for it through requestedScene,
+    //swapInPendingFilterBank hands it over and reports the slot back through recalledScene
+    std::array<std::unique_ptr<FilterBank>, numScaleSnapshots> sceneBanks;
+    std::array<ScaleBus::StageList::Ptr, numScaleSnapshots> sceneStages;
+    std::array<ResponseSnapshot, numScaleSnapshots> sceneResponses;
+    std::atomic<int> requestedScene{ -1 };
+    std::atomic<int> recalledScene{ -1 };
+    std::atomic<bool> sceneBanksStale{ false };
+
+    ScaleSnapshot captureLiveSnapshot() const;
+    ScaleBus::StageList::Ptr makeNotchStages(const ScaleSnapshot& snapshot) const;
+    std::unique_ptr<FilterBank> buildFilterBank(const ScaleSnapshot& snapshot, ScaleBus::StageList::Ptr& notchStages) const;
+    void queueSnapshotBank(const ScaleSnapshot& snapshot, double fadeMilliseconds);
+    void queueFilterBank(std::unique_ptr<FilterBank> bank, double fadeMilliseconds);
+    void swapInPendingFilterBank();
+    bool banksShareState() const;
+    void collectRetiredBank();
+    void processFilterBanks(juce::AudioBuffer<float>& buffer, bool monoInput);
+    void prepareSceneBanks();
+    void invalidateSceneBanks();
+    void applyRecalledScene(int slot);
+    bool applyingScene = false;          // message thread only
+    bool handlingAsyncUpdate = false;    // message thread only
+    void setParameterFromProcessor(const juce::String& parameterID, float value);
+    void writeScaleSnapshotsToState();
+    void readScaleSnapshotsFromState(const juce::ValueTree& state);
+
+    //key mask mirrored from activeFreqs (bit i = key i) and the process wide bus
+    std::atomic<juce::uint32> activeKeyMask{ 0 };
+    static juce::uint32 maskFromKeys(const std::vector<int>& keys);
+    void setActiveKeyMask(juce::uint32 mask);
+    juce::SharedResourcePointer<ScaleBus> scaleBus;
+    std::atomic<juce::uint32> lastBusGeneration{ 0 };
+    std::atomic<juce::uint32> busKeyMask{ 0 };
+    std::atomic<bool> busKeysPending{ false };
+    std::atomic<bool> busRebuildPending{ false };
+    void pollScaleBus();
+    bool adoptBusStages(const ScaleBus::StageList& stages);
+    void applyBusKeys();
+
+    //followers take bus changes on the audio thread: spareBank (reserved for
+    //maxPreparedStages, recycled from finished fades) is refilled with the leader's
+    //coefficients, and the references it drops wait in releasedStages for collectRetiredBank.
+    //both sit under bankLock, adoptedStages is audio thread only
+    std::unique_ptr<FilterBank> spareBank;
+    std::vector<CombBiquad::CoefficientsPtr> releasedStages;
+    static constexpr size_t releasedStagesCapacity = 2 * FilterBank::maxPreparedStages;
+    ScaleBus::StageList::Ptr adoptedStages;
+
+    ResponseSnapshot responseSnapshot;
+    mutable juce::SpinLock responseLock;
+    std::atomic<juce::uint32> responseGeneration{ 0 };
+    ResponseSnapshot makeResponseSnapshot(const FilterBank& bank) const;
+    void publishResponseSnapshot(ResponseSnapshot snapshot);
+
+    //cpu governor, tiers are Full, Trim (top octave dropped), Merge (plus neighbouring
+    //notches merged) and Lean (two top octaves dropped, merged)
+    static constexpr int numQualityTiers = 4;
+    static constexpr float governorStepDownLoad = 0.75f;
+    static constexpr float governorStepUpLoad = 0.35f;
+    static constexpr double governorStepDownSeconds = 0.5;
+    static constexpr double governorStepUpSeconds = 4.0;
+    static constexpr double governorSettleSeconds = 1.0;   // minimum time between two tier changes
+    float governorLoad = 0.0f;
+    juce::int64 samplesSinceTierChange = 0;
+    juce::int64 samplesAboveStepDown = 0;
+    juce::int64 samplesBelowStepUp = 0;
+    std::atomic<int> governorTier{ 0 };
+    void updateGovernor(double elapsedSeconds, int numSamples);
+    void publishGovernorTier();
+    void handleAsyncUpdate() override;
+    static void mergeAdjacentNotches(std::vector<std::pair<float, float>>& notches);
 
 
 
@@ -128,12 +271,30 @@ private:
 
 
 
+template <size_t Index = 0>
+void copyFilterChainStateRecursive(const FixedFilterChain& source, FixedFilterChain& destination)
+{
+    if constexpr (Index < 7)
+    {
+        destination.template get<Index>().copyStateFrom(source.template get<Index>());
+        copyFilterChainStateRecursive<Index + 1>(source, destination);
+    }
+}
+
+template <size_t Index = 0>
+bool filterChainStatesMatchRecursive(const FixedFilterChain& first, const FixedFilterChain& second)
+{
+    if constexpr (Index < 7)
+    {
+        return first.template get<Index>().hasSameStateAs(second.template get<Index>())
+            && filterChainStatesMatchRecursive<Index + 1>(first, second);
+    }
+    return true;
+}
+
 template <size_t Index = 0>
 void updateFilterChainRecursive(
-    juce::dsp::ProcessorChain<
-    juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-    juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Filter<float>,
-    juce::dsp::IIR::Filter<float>>&chain,
+    FixedFilterChain& chain,
     const std::vector<float>& freqs,
     double sampleRate, float qKnobVal, int currentFunction)
 {
@@ -0,0 +1,148 @@
+/*
+  ==============================================================================
+
+    Magnitude response overlay for the editor's spectrum area.
+
+  ==============================================================================
+*/
+
+#include "ResponseCurveComponent.h"
+
+ResponseCurveComponent::ResponseCurveComponent(ColourCombV4AudioProcessor& p)
+    : juce::Thread("ColourComb response curve"), audioProcessor(p)
+{
+    setInterceptsMouseClicks(false, false);
+    startThread(juce::Thread::Priority::low);
+    startTimerHz(15);
+}
+
+ResponseCurveComponent::~ResponseCurveComponent()
+{
+    stopTimer();
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+    notify();
+    stopThread(2000);
+}
+
+void ResponseCurveComponent::paint(juce::Graphics& g)
+{
+    const auto bounds = getLocalBounds().toFloat();
+    const auto zeroDbY = juce::jmap(0.0f, (float)minDb, (float)maxDb, bounds.getBottom(), bounds.getY());
+    g.setColour(juce::Colours::lightgrey);
+    g.drawHorizontalLine(juce::roundToInt(zeroDbY), bounds.getX(), bounds.getRight());
+
+    juce::Path path;
+    {
+        const juce::SpinLock::ScopedLockType lock(pathLock);
+        path = responsePath;
+    }
+
+    g.setColour(juce::Colours::royalblue.withAlpha(0.6f));
+    g.strokePath(path, juce::PathStrokeType(1.5f), juce::AffineTransform::scale(bounds.getWidth(), bounds.getHeight()));
+}
+
+//only looks at an atomic counter, the coefficients are copied when they actually changed
+void ResponseCurveComponent::timerCallback()
+{
+    const auto generation = audioProcessor.getResponseGeneration();
+    if (hasRequested && generation == lastGeneration)
+        return;
+
+    hasRequested = true;
+    lastGeneration = generation;
+    auto snapshot = audioProcessor.getResponseSnapshot();
+    {
+        const juce::SpinLock::ScopedLockType lock(pathLock);
+        std::swap(pendingSnapshot, snapshot);
+        hasPendingSnapshot = true;
+    }
+    notify();
+}
+
+void ResponseCurveComponent::handleAsyncUpdate()
+{
+    repaint();
+}
+
+void ResponseCurveComponent::run()
+{
+    while (!threadShouldExit()) {
+        wait(-1);
+
+        ColourCombV4AudioProcessor::ResponseSnapshot snapshot;
+        {
+            const juce::SpinLock::ScopedLockType lock(pathLock);
+            if (!hasPendingSnapshot)
+                continue;
+            std::swap(snapshot, pendingSnapshot);
+            hasPendingSnapshot = false;
+        }
+
+        auto path = evaluateResponse(snapshot);
+        {
+            const juce::SpinLock::ScopedLockType lock(pathLock);
+            responsePath.swapWithPath(path);
+        }
+        triggerAsyncUpdate();
+    }
+}
+
+void ResponseCurveComponent::prepareFrequencyGrid(double sampleRate)
+{
+    if (sampleRate == gridSampleRate)
+        return;
+
+    gridSampleRate = sampleRate;
+    for (auto* v : { &cosOmega, &cosTwoOmega, &numerator, &denominator, &numeratorProduct, &denominatorProduct })
+        v->resize(numPoints);
+
+    const double topFrequency = juce::jmin(maxFrequency, sampleRate * 0.5);
+    for (int i = 0; i < numPoints; ++i) {
+        const double frequency = minFrequency * std::pow(topFrequency / minFrequency, i / (double)(numPoints - 1));
+        const double omega = juce::MathConstants<double>::twoPi * frequency / sampleRate;
+        cosOmega[i] = std::cos(omega);
+        cosTwoOmega[i] = std::cos(2.0 * omega);
+    }
+}
+
+//|H|^2 of each biquad is (p0 + p1 cos w + p2 cos 2w) / (q0 + q1 cos w + q2 cos 2w), so a whole
+//bank is two running products over the grid, one vector op per term
+juce::Path ResponseCurveComponent::evaluateResponse(const ColourCombV4AudioProcessor::ResponseSnapshot& snapshot)
+{
+    juce::Path path;
+    if (snapshot.sampleRate <= 0.0)
+        return path;
+
+    prepareFrequencyGrid(snapshot.sampleRate);
+    juce::FloatVectorOperations::fill(numeratorProduct.data(), 1.0, numPoints);
+    juce::FloatVectorOperations::fill(denominatorProduct.data(), 1.0, numPoints);
+
+    for (const auto& c : snapshot.biquads) {
+        const double b0 = c[0], b1 = c[1], b2 = c[2], a1 = c[3], a2 = c[4];
+
+        juce::FloatVectorOperations::fill(numerator.data(), b0 * b0 + b1 * b1 + b2 * b2, numPoints);
+        juce::FloatVectorOperations::addWithMultiply(numerator.data(), cosOmega.data(), 2.0 * (b0 * b1 + b1 * b2), numPoints);
+        juce::FloatVectorOperations::addWithMultiply(numerator.data(), cosTwoOmega.data(), 2.0 * b0 * b2, numPoints);
+
+        juce::FloatVectorOperations::fill(denominator.data(), 1.0 + a1 * a1 + a2 * a2, numPoints);
+        juce::FloatVectorOperations::addWithMultiply(denominator.data(), cosOmega.data(), 2.0 * (a1 + a1 * a2), numPoints);
+        juce::FloatVectorOperations::addWithMultiply(denominator.data(), cosTwoOmega.data(), 2.0 * a2, numPoints);
+
+        juce::FloatVectorOperations::multiply(numeratorProduct.data(), numerator.data(), numPoints);
+        juce::FloatVectorOperations::multiply(denominatorProduct.data(), denominator.data(), numPoints);
+    }
+
+    //unit coordinates, x along log frequency and y from maxDb (0) down to minDb (1)
+    for (int i = 0; i < numPoints; ++i) {
+        const double powerRatio = juce::jmax(numeratorProduct[i], 0.0) / juce::jmax(denominatorProduct[i], 1.0e-300);
+        const double db = juce::jlimit(minDb, maxDb, 10.0 * std::log10(juce::jmax(powerRatio, 1.0e-12)));
+        const float x = i / (float)(numPoints - 1);
+        const float y = (float)juce::jmap(db, maxDb, minDb, 0.0, 1.0);
+        if (i == 0)
+            path.startNewSubPath(x, y);
+        else
+            path.lineTo(x, y);
+    }
+    return path;
+}
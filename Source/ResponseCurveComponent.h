@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    Magnitude response overlay for the editor's spectrum area.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+//==============================================================================
+/**
+    Draws the combined response of the processor's current filter bank.
+
+    A slow timer watches the processor's response generation. When it moves,
+    the coefficient snapshot is handed to a background thread that evaluates
+    every biquad at numPoints log spaced frequencies and builds a path in
+    unit coordinates. paint() only strokes that cached path.
+*/
+class ResponseCurveComponent : public juce::Component,
+    private juce::Timer,
+    private juce::Thread,
+    private juce::AsyncUpdater
+{
+public:
+    explicit ResponseCurveComponent(ColourCombV4AudioProcessor&);
+    ~ResponseCurveComponent() override;
+
+    void paint(juce::Graphics&) override;
+
+private:
+    void timerCallback() override;
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    juce::Path evaluateResponse(const ColourCombV4AudioProcessor::ResponseSnapshot& snapshot);
+    void prepareFrequencyGrid(double sampleRate);
+
+    static constexpr int numPoints = 1024;
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr double minDb = -60.0;
+    static constexpr double maxDb = 12.0;
+
+    ColourCombV4AudioProcessor& audioProcessor;
+    juce::uint32 lastGeneration = 0;
+    bool hasRequested = false;
+
+    //handed between the message thread and the worker under pathLock
+    juce::SpinLock pathLock;
+    ColourCombV4AudioProcessor::ResponseSnapshot pendingSnapshot;
+    bool hasPendingSnapshot = false;
+    juce::Path responsePath;
+
+    //worker thread only
+    double gridSampleRate = 0.0;
+    std::vector<double> cosOmega, cosTwoOmega, numerator, denominator, numeratorProduct, denominatorProduct;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResponseCurveComponent)
+};
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    Process wide key selection shared between ColourComb instances.
+
+  ==============================================================================
+*/
+
+#include "ScaleBus.h"
+
+void ScaleBus::publish(StageList::Ptr stagesToShare)
+{
+    if (stagesToShare == nullptr)
+        return;
+
+    //lists only the bus still holds can go, the rest are in some follower's hands
+    std::vector<StageList::Ptr> released;
+    {
+        const juce::SpinLock::ScopedLockType lock(stagesLock);
+        if (stages != nullptr && stages->hasSameNotchesAs(*stagesToShare))
+            return;
+
+        for (auto it = publishedStages.begin(); it != publishedStages.end();) {
+            if ((*it)->getReferenceCount() == 1 && *it != stages) {
+                released.push_back(std::move(*it));
+                it = publishedStages.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        publishedStages.push_back(stagesToShare);
+        stages = stagesToShare;
+    }
+
+    auto current = state.load(std::memory_order_relaxed);
+    juce::uint64 next;
+    do {
+        auto generation = generationOf(current) + 1;
+        if (generation == 0)
+            generation = 1;
+        next = ((juce::uint64)generation << 32) | stagesToShare->keyMask;
+    } while (!state.compare_exchange_weak(current, next, std::memory_order_release, std::memory_order_relaxed));
+    //the released lists go out of scope here, after the lock is released
+}
+
+ScaleBus::StageList::Ptr ScaleBus::getStages() const
+{
+    const juce::SpinLock::ScopedLockType lock(stagesLock);
+    return stages;
+}
+
+bool ScaleBus::tryGetStages(StageList::Ptr& result) const
+{
+    const juce::SpinLock::ScopedTryLockType lock(stagesLock);
+    if (!lock.isLocked())
+        return false;
+
+    //the list result held before is still in publishedStages, so this only drops a count
+    result = stages;
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    Process wide key selection shared between ColourComb instances.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+#include "CombBiquad.h"
+
+//==============================================================================
+/**
+    One of these exists per process, instances reach it through a
+    juce::SharedResourcePointer. A leader publishes its key mask together
+    with the notch coefficients it built as one immutable, ref-counted
+    StageList; followers poll the packed generation/mask word once per
+    block and, when it moved, copy the list's coefficient pointers into a
+    bank they prepared ahead, on the audio thread.
+
+    The word is a single lock-free atomic. The current list sits behind a
+    SpinLock that followers only ever try, and every published list is kept
+    alive by the bus until no instance holds it any more, so a follower
+    dropping its reference never frees anything on the audio thread.
+*/
+class ScaleBus
+{
+public:
+    enum Mode { off = 0, leader, follower };
+
+    struct StageList : public juce::ReferenceCountedObject
+    {
+        using Ptr = juce::ReferenceCountedObjectPtr<StageList>;
+
+        double sampleRate = 0.0;
+        juce::uint32 keyMask = 0;
+        std::vector<std::pair<float, float>> notchSpecs;     // frequency and Q of each notch
+        std::vector<CombBiquad::CoefficientsPtr> notches;
+
+        bool hasSameNotchesAs(const StageList& other) const
+        {
+            return sampleRate == other.sampleRate && keyMask == other.keyMask && notchSpecs == other.notchSpecs;
+        }
+    };
+
+    /** Message thread. Lists that match the current one are dropped so followers don't fade for nothing. */
+    void publish(StageList::Ptr stagesToShare);
+
+    /** Message thread. */
+    StageList::Ptr getStages() const;
+
+    /** Audio thread safe, never blocks and never allocates. False while a leader is publishing. */
+    bool tryGetStages(StageList::Ptr& result) const;
+
+    /** Generation in the upper 32 bits, key mask in the lower. Generation 0 means nothing was published yet. */
+    juce::uint64 getState() const noexcept { return state.load(std::memory_order_acquire); }
+    static juce::uint32 generationOf(juce::uint64 packed) noexcept { return (juce::uint32)(packed >> 32); }
+    static juce::uint32 keyMaskOf(juce::uint64 packed) noexcept { return (juce::uint32)(packed & 0xffffffffu); }
+
+private:
+    std::atomic<juce::uint64> state{ 0 };
+    mutable juce::SpinLock stagesLock;
+    StageList::Ptr stages;
+    std::vector<StageList::Ptr> publishedStages;
+};
@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    Note frequency tables for the comb, generated from a reference pitch and
+    a tuning (12-TET by default, or a Scala .scl scale).
+
+  ==============================================================================
+*/
+
+#include "TuningTable.h"
+
+void TuningTable::resetToEqualTemperament()
+{
+    equalTemperament = true;
+    degreeCents.clear();
+    periodCents = 1200.0;
+    description = {};
+}
+
+//scala pitch lines are cents when they hold a '.', otherwise a ratio like 3/2 or a plain integer
+static bool parseScalaPitch(const juce::String& token, double& cents)
+{
+    if (token.containsChar('.')) {
+        if (!token.containsOnly("0123456789.-+"))
+            return false;
+        cents = token.getDoubleValue();
+        return true;
+    }
+
+    if (!token.containsOnly("0123456789/"))
+        return false;
+
+    const auto numerator = (double)token.upToFirstOccurrenceOf("/", false, false).getLargeIntValue();
+    const auto denominator = token.containsChar('/') ? (double)token.fromFirstOccurrenceOf("/", false, false).getLargeIntValue() : 1.0;
+    if (numerator <= 0.0 || denominator <= 0.0)
+        return false;
+
+    cents = 1200.0 * std::log2(numerator / denominator);
+    return true;
+}
+
+juce::Result TuningTable::loadScala(const juce::String& sclText)
+{
+    //comment lines start with '!', anything else counts, including a blank description
+    juce::StringArray lines;
+    for (const auto& line : juce::StringArray::fromLines(sclText))
+        if (!line.trimStart().startsWithChar('!'))
+            lines.add(line.trim());
+
+    if (lines.size() < 2)
+        return juce::Result::fail("Missing the description or note count line");
+
+    const auto countText = lines[1].upToFirstOccurrenceOf(" ", false, false);
+    const int numNotes = countText.getIntValue();
+    if (!countText.containsOnly("0123456789") || numNotes < 1)
+        return juce::Result::fail("Invalid note count: " + lines[1]);
+
+    //one table row per key, the keyboard and the key parameter only have twelve
+    if (numNotes != Tuning::defaultNotesPerOctave)
+        return juce::Result::fail("Only scales with " + juce::String(Tuning::defaultNotesPerOctave)
+            + " notes per period are supported, this one has " + juce::String(numNotes));
+
+    std::vector<double> pitches;
+    for (int i = 2; i < lines.size() && (int)pitches.size() < numNotes; ++i) {
+        const auto token = lines[i].replaceCharacter('\t', ' ').upToFirstOccurrenceOf(" ", false, false);
+        if (token.isEmpty())
+            continue;
+
+        double cents = 0.0;
+        if (!parseScalaPitch(token, cents))
+            return juce::Result::fail("Invalid pitch: " + lines[i]);
+        pitches.push_back(cents);
+    }
+
+    if ((int)pitches.size() != numNotes)
+        return juce::Result::fail("Expected " + juce::String(numNotes) + " pitches, found " + juce::String((int)pitches.size()));
+
+    //the last pitch is the period the scale repeats at, usually 2/1. a tiny period would
+    //expand into a huge table and a notch for every entry
+    if (pitches.back() < Tuning::minPeriodCents)
+        return juce::Result::fail("The period must be at least " + juce::String(Tuning::minPeriodCents, 0) + " cents above the tonic");
+
+    equalTemperament = false;
+    periodCents = pitches.back();
+    degreeCents.assign(1, 0.0);
+    degreeCents.insert(degreeCents.end(), pitches.begin(), pitches.end() - 1);
+    description = lines[0];
+    return juce::Result::ok();
+}
+
+std::vector<std::vector<float>> TuningTable::generate(double referencePitch, double sampleRate) const
+{
+    const double nyquist = sampleRate * 0.5;
+    std::vector<std::vector<float>> table;
+
+    if (equalTemperament) {
+        //the compile time table only needs rescaling for another reference pitch
+        const double scale = referencePitch / Tuning::defaultReferencePitch;
+        for (const auto& row : Tuning::defaultNoteFrequencies) {
+            auto& frequencies = table.emplace_back();
+            for (auto frequency : row) {
+                if (frequency * scale >= nyquist)
+                    break;
+                frequencies.push_back((float)(frequency * scale));
+            }
+        }
+        return table;
+    }
+
+    const double tonic = referencePitch * std::pow(2.0, Tuning::referenceToTonicCents / 1200.0);
+    const double periodRatio = std::pow(2.0, periodCents / 1200.0);
+    for (auto cents : degreeCents) {
+        auto& frequencies = table.emplace_back();
+        for (double frequency = tonic * std::pow(2.0, cents / 1200.0); frequency < nyquist; frequency *= periodRatio)
+            frequencies.push_back((float)frequency);
+    }
+    return table;
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Note frequency tables for the comb, generated from a reference pitch and
+    a tuning (12-TET by default, or a Scala .scl scale).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+
+namespace Tuning
+{
+    constexpr int defaultNotesPerOctave = 12;
+    constexpr int maxDefaultOctaves = 12;            // C3 * 2^11 is about 268kHz, past nyquist at 384kHz
+    constexpr double defaultReferencePitch = 440.0;  // A4
+    constexpr double referenceToTonicCents = -2100.0; // A4 down to C3, the lowest row of the table
+    constexpr double minPeriodCents = 10.0;           // smallest Scala period accepted
+
+    //2^x that can run at compile time, std::pow can't before c++26
+    constexpr double exp2(double x)
+    {
+        int whole = static_cast<int>(x);
+        if (x < whole)
+            --whole;
+
+        const double fraction = x - whole;
+        double term = 1.0, sum = 1.0;
+        for (int n = 1; n < 24; ++n) {
+            term *= fraction * 0.69314718055994530942 / n;
+            sum += term;
+        }
+
+        for (int i = 0; i < whole; ++i)
+            sum *= 2.0;
+        for (int i = 0; i > whole; --i)
+            sum *= 0.5;
+        return sum;
+    }
+
+    using DefaultTable = std::array<std::array<float, maxDefaultOctaves>, defaultNotesPerOctave>;
+
+    constexpr DefaultTable makeEqualTemperedTable(double referencePitch)
+    {
+        DefaultTable table{};
+        for (int note = 0; note < defaultNotesPerOctave; ++note)
+            for (int octave = 0; octave < maxDefaultOctaves; ++octave)
+                table[note][octave] = static_cast<float>(referencePitch
+                    * exp2((referenceToTonicCents + 100.0 * note) / 1200.0 + octave));
+        return table;
+    }
+
+    //12-TET at A=440, baked in at compile time
+    inline constexpr DefaultTable defaultNoteFrequencies = makeEqualTemperedTable(defaultReferencePitch);
+}
+
+//==============================================================================
+/**
+    Holds a tuning as cents above the tonic for each scale degree plus the
+    period it repeats at, and expands it into the processor's noteFrequencies
+    layout: one row per degree, one column per period up to nyquist.
+*/
+class TuningTable
+{
+public:
+    TuningTable() = default;
+
+    /** Back to plain 12-TET, which is served from Tuning::defaultNoteFrequencies. */
+    void resetToEqualTemperament();
+
+    /** Parses the contents of a Scala .scl file, leaves the tuning untouched on failure.
+        Only twelve note scales are accepted, one per key of the keyboard. */
+    juce::Result loadScala(const juce::String& sclText);
+
+    bool isEqualTemperament() const { return equalTemperament; }
+    int getNumDegrees() const { return (int)degreeCents.size(); }
+    const juce::String& getDescription() const { return description; }
+
+    /** Table for the given reference pitch (A4) with every row running up to nyquist. */
+    std::vector<std::vector<float>> generate(double referencePitch, double sampleRate) const;
+
+private:
+    bool equalTemperament = true;
+    std::vector<double> degreeCents;  // first entry is always the tonic at 0 cents
+    double periodCents = 1200.0;
+    juce::String description;
+};